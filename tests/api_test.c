@@ -0,0 +1,287 @@
+/* Tests of the libxdgmenu API, using desktop files in a temporary directory.
+ * Print the failed checks to stderr and exit with 1 if any. */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xdgmenu.h"
+
+#define NTHREADS 8
+
+#define CHECK(X) do { \
+	if (!(X)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #X); \
+		failures++; \
+	} \
+} while (0)
+
+char root[XDGMENU_SLEN], apps_dir[XDGMENU_MLEN];
+int failures;
+
+int  count_apps(XdgMenu *menu, const char *text);
+void make_old(const char *name);
+void make_old_path(const char *path);
+void remove_file(const char *name);
+void run_icons();
+void run_locale();
+void run_query();
+void run_refresh();
+void run_scan_twice();
+void run_threads();
+void *thread_scan(void *arg);
+void write_file(const char *name, const char *content);
+void write_path(const char *path, const char *content);
+
+int count_apps(XdgMenu *menu, const char *text)
+{
+	int count = 0;
+
+	for (XdgMenuApp *app = xdgmenu_query(menu, NULL, text); app;
+			app = xdgmenu_query(menu, app, text))
+		count++;
+	return count;
+}
+
+/* set the mtime of a file in the app folder in the past, NULL for the folder */
+void make_old(const char *name)
+{
+	char path[XDGMENU_LLEN] = {0};
+
+	snprintf(path, XDGMENU_LLEN, "%s/%s", apps_dir, name ? name : "");
+	make_old_path(path);
+}
+
+void make_old_path(const char *path)
+{
+	struct timespec times[2] = {{time(NULL) - 100, 0}, {time(NULL) - 100, 0}};
+
+	utimensat(AT_FDCWD, path, times, 0);
+}
+
+void remove_file(const char *name)
+{
+	char path[XDGMENU_LLEN] = {0};
+
+	snprintf(path, XDGMENU_LLEN, "%s/%s", apps_dir, name);
+	unlink(path);
+}
+
+void write_file(const char *name, const char *content)
+{
+	char path[XDGMENU_LLEN] = {0};
+
+	snprintf(path, XDGMENU_LLEN, "%s/%s", apps_dir, name);
+	write_path(path, content);
+}
+
+void write_path(const char *path, const char *content)
+{
+	FILE *fp;
+
+	if ((fp = fopen(path, "w")) == NULL) {
+		perror(path);
+		exit(1);
+	}
+	fputs(content, fp);
+	fclose(fp);
+}
+
+/* an icon installed after a failed search is found after a refresh, also in
+ * an icon dir removed and created again */
+void run_icons()
+{
+	char theme_dir[XDGMENU_MLEN] = {0}, path[XDGMENU_LLEN] = {0};
+	XdgMenuOption option = xdgmenu_default_option();
+	XdgMenuApp *app;
+	XdgMenu *menu;
+
+	snprintf(theme_dir, XDGMENU_MLEN, "%s/icons/hicolor", root);
+	snprintf(path, XDGMENU_LLEN, "%s/icons", root);
+	mkdir(path, 0755);
+	mkdir(theme_dir, 0755);
+	snprintf(path, XDGMENU_LLEN, "%s/index.theme", theme_dir);
+	write_path(path, "[Icon Theme]\nName=Hicolor\nDirectories=apps\n\n"
+		"[apps]\nSize=24\nType=Fixed\n");
+	snprintf(path, XDGMENU_LLEN, "%s/apps", theme_dir);
+	mkdir(path, 0755);
+	make_old_path(path);
+	write_file("late.desktop", "[Desktop Entry]\nType=Application\nName=Late\n"
+		"Exec=late\nIcon=late-icon-symbolic\n");
+	make_old("late.desktop");
+	make_old(NULL);
+
+	option.icon_theme = "hicolor";
+	menu = xdgmenu_new(option);
+	xdgmenu_scan(menu);
+	CHECK((app = xdgmenu_query(menu, NULL, "late")) && !strstr(app->xmenu_entry, "late-icon.png"));
+
+	snprintf(path, XDGMENU_LLEN, "%s/apps/late-icon.png", theme_dir);
+	write_path(path, "");
+	CHECK(xdgmenu_refresh(menu) == 0);
+	CHECK((app = xdgmenu_query(menu, NULL, "late")) && strstr(app->xmenu_entry, "late-icon.png"));
+
+	unlink(path);
+	snprintf(path, XDGMENU_LLEN, "%s/apps", theme_dir);
+	rmdir(path);
+	mkdir(path, 0755);
+	snprintf(path, XDGMENU_LLEN, "%s/apps/late-icon.png", theme_dir);
+	write_path(path, "");
+	snprintf(path, XDGMENU_LLEN, "%s/apps", theme_dir);
+	make_old_path(path);
+	CHECK(xdgmenu_refresh(menu) == 0);
+	CHECK((app = xdgmenu_query(menu, NULL, "late")) && strstr(app->xmenu_entry, "late-icon.png"));
+	xdgmenu_free(menu);
+
+	remove_file("late.desktop");
+	make_old(NULL);
+}
+
+/* localized comments are searched, the unlocalized one is not used then */
+void run_locale()
+{
+	XdgMenu *menu;
+
+	write_file("locale.desktop", "[Desktop Entry]\nType=Application\nName=Gamma\nExec=gamma\n"
+		"Comment[de]=Ein Kommentar\nComment=A comment\nComment[fr]=Un commentaire\n");
+	setenv("LANG", "de_DE.UTF-8", 1);
+	menu = xdgmenu_new(xdgmenu_default_option());
+	xdgmenu_scan(menu);
+	CHECK(count_apps(menu, "ein kommentar") == 1);
+	CHECK(count_apps(menu, "a comment") == 0);
+	CHECK(count_apps(menu, "un commentaire") == 0);
+	xdgmenu_free(menu);
+	unsetenv("LANG");
+	remove_file("locale.desktop");
+	make_old(NULL);
+}
+
+void run_query()
+{
+	XdgMenu *menu = xdgmenu_new(xdgmenu_default_option());
+
+	xdgmenu_scan(menu);
+	CHECK(count_apps(menu, "") == 2);
+	CHECK(count_apps(menu, "alpha") == 1);
+	CHECK(count_apps(menu, "BROWSER") == 1);
+	CHECK(count_apps(menu, "the web") == 1);
+	CHECK(count_apps(menu, "hidden") == 0);
+	CHECK(count_apps(menu, "nothing like this") == 0);
+	xdgmenu_free(menu);
+}
+
+void run_refresh()
+{
+	XdgMenu *menu = xdgmenu_new(xdgmenu_default_option());
+
+	xdgmenu_scan(menu);
+	CHECK(xdgmenu_refresh(menu) == 0);
+
+	/* add a file */
+	write_file("new.desktop", "[Desktop Entry]\nType=Application\nName=New\nExec=new\n");
+	CHECK(xdgmenu_refresh(menu) == 1);
+	CHECK(count_apps(menu, "new") == 1);
+	CHECK(count_apps(menu, "") == 3);
+
+	/* edit a hidden file in place */
+	make_old(NULL);
+	make_old("new.desktop");
+	write_file("hidden.desktop", "[Desktop Entry]\nType=Application\nName=Hidden\nExec=hidden\n");
+	CHECK(xdgmenu_refresh(menu) == 1);
+	CHECK(count_apps(menu, "hidden") == 1);
+	CHECK(count_apps(menu, "") == 4);
+
+	/* remove files */
+	make_old("hidden.desktop");
+	remove_file("new.desktop");
+	remove_file("hidden.desktop");
+	CHECK(xdgmenu_refresh(menu) == 1);
+	CHECK(count_apps(menu, "new") == 0);
+	CHECK(count_apps(menu, "hidden") == 0);
+	CHECK(count_apps(menu, "") == 2);
+	xdgmenu_free(menu);
+}
+
+void run_scan_twice()
+{
+	XdgMenu *menu = xdgmenu_new(xdgmenu_default_option());
+
+	xdgmenu_scan(menu);
+	xdgmenu_scan(menu);
+	CHECK(count_apps(menu, "") == 2);
+	xdgmenu_free(menu);
+}
+
+void *thread_scan(void *arg)
+{
+	XdgMenu *menu = xdgmenu_new(xdgmenu_default_option());
+	FILE *fp = fopen("/dev/null", "w");
+
+	xdgmenu_scan(menu);
+	xdgmenu_dump(menu, fp);
+	*(int *)arg = count_apps(menu, "") == 2 && count_apps(menu, "alpha") == 1
+		&& xdgmenu_refresh(menu) == 0;
+	fclose(fp);
+	xdgmenu_free(menu);
+	return NULL;
+}
+
+void run_threads()
+{
+	pthread_t threads[NTHREADS];
+	int results[NTHREADS] = {0};
+
+	for (int i = 0; i < NTHREADS; i++)
+		pthread_create(&threads[i], NULL, thread_scan, &results[i]);
+	for (int i = 0; i < NTHREADS; i++) {
+		pthread_join(threads[i], NULL);
+		CHECK(results[i]);
+	}
+}
+
+int main()
+{
+	char cmd[XDGMENU_LLEN] = {0};
+
+	snprintf(root, XDGMENU_SLEN, "%s", "/tmp/xdgmenu-test.XXXXXX");
+	if (mkdtemp(root) == NULL) {
+		perror("mkdtemp");
+		return 1;
+	}
+	snprintf(apps_dir, XDGMENU_MLEN, "%s/applications", root);
+	mkdir(apps_dir, 0755);
+
+	/* search only the temporary directory, and ignore the user's settings */
+	setenv("XDG_DATA_HOME", root, 1);
+	setenv("XDG_DATA_DIRS", "", 1);
+	setenv("XDG_CONFIG_HOME", root, 1);
+	unsetenv("LC_ALL");
+	unsetenv("LC_MESSAGES");
+	unsetenv("LANG");
+
+	write_file("alpha.desktop", "[Desktop Entry]\nType=Application\nName=Alpha\n"
+		"GenericName=Web Browser\nComment=Surf the web\nExec=alpha\n");
+	write_file("beta.desktop", "[Desktop Entry]\nType=Application\nName=Beta\nExec=beta\n");
+	write_file("hidden.desktop", "[Desktop Entry]\nType=Application\nName=Hidden\n"
+		"Exec=hidden\nNoDisplay=true\n");
+	make_old("alpha.desktop");
+	make_old("beta.desktop");
+	make_old("hidden.desktop");
+	make_old(NULL);
+
+	run_query();
+	run_scan_twice();
+	run_threads();
+	run_locale();
+	run_refresh();
+	run_icons();
+
+	snprintf(cmd, XDGMENU_LLEN, "rm -rf '%s'", root);
+	system(cmd);
+	return failures > 0;
+}
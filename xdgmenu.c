@@ -0,0 +1,1033 @@
+/* Author: Lu Xu <oliver_lew at outlook dot com>
+ * License: MIT
+ * References: https://specifications.freedesktop.org/desktop-entry-spec
+ *             https://specifications.freedesktop.org/icon-theme-spec
+ */
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ini.h>
+
+#include "xdgmenu.h"
+
+/* for long texts */
+#define LLEN XDGMENU_LLEN
+/* for file paths */
+#define MLEN XDGMENU_MLEN
+/* for simple names or directories */
+#define SLEN XDGMENU_SLEN
+
+#define LEN(X) (sizeof(X) / sizeof(X[0]))
+
+typedef XdgMenuAction Action;
+typedef XdgMenuApp App;
+typedef XdgMenuOption Option;
+
+typedef struct List {
+	char text[SLEN];
+	int fd;
+	struct timespec mtime;  /* of icon dirs, zero if missing */
+	struct List *next;
+} List;
+
+typedef struct Icon {
+	char name[SLEN];
+	char path[MLEN];  /* empty if not found */
+	struct Icon *next;
+} Icon;
+
+struct XdgMenu {
+	Option option;
+	/* from environment variables */
+	char home[SLEN];
+	char xdg_config_home[SLEN];
+	List path_list, data_dirs_list, current_desktop_list;
+	/* locale suffixes of keys like "[de_DE]", from the best match to the worst */
+	char locales[4][SLEN];
+	int nlocales;
+	/* icon index */
+	char icon_theme[SLEN];
+	char fallback_icon_path[MLEN];
+	List icon_dirs;
+	/* lookup results of icon names, both found and not found */
+	Icon *icon_cache[256];
+	/* apps found in all data dirs, and the time they were found */
+	App all_apps;
+	time_t scan_time;
+};
+
+/* user data of handler_parse_app, with the locale ranks of the kept values */
+typedef struct ParseApp {
+	XdgMenu *menu;
+	App *app;
+	int rank_name, rank_genericname, rank_comment, rank_action_name;
+} ParseApp;
+
+/* user data of handler_icon_dirs_theme, the state of the current section */
+typedef struct ParseTheme {
+	XdgMenu *menu;
+	char subdir[32];
+	char type[16];
+	int size, minsize, maxsize, threshold, scale;
+} ParseTheme;
+
+static struct Category2Name {
+	char *category;
+	char *name;
+} xdg_categories[] = {
+	{"Audio", "Multimedia"},
+	{"AudioVideo", "Multimedia"},
+	{"Development", "Development"},
+	{"Education", "Education"},
+	{"Game", "Games"},
+	{"Graphics", "Graphics"},
+	{"Network", "Internet"},
+	{"Office", "Office"},
+	{"Others", "Others"},
+	{"Science", "Science"},
+	{"Settings", "Settings"},
+	{"System", "System"},
+	{"Utility", "Accessories"},
+	{"Video", "Multimedia"}
+};
+
+static struct Name2Icon {
+	char *category;
+	char *icon;
+} category_icons[] = {
+	{"Accessories", "applications-accessories"},
+	{"Development", "applications-development"},
+	{"Education", "applications-education"},
+	{"Games", "applications-games"},
+	{"Graphics", "applications-graphics"},
+	{"Internet", "applications-internet"},
+	{"Multimedia", "applications-multimedia"},
+	{"Office", "applications-office"},
+	{"Others", "applications-other"},
+	{"Science", "applications-science"},
+	{"Settings", "preferences-desktop"},
+	{"System", "applications-system"}
+};
+
+static int  cmp_app_category_name(const void *p1, const void *p2);
+static int  check_app(App *app);
+static int  check_desktop(XdgMenu *menu, const char *desktop_list);
+static int  check_exec(XdgMenu *menu, const char *cmd);
+static int  check_folder_changed(XdgMenu *menu, const char *folder, time_t since);
+static int  check_icon_dirs_changed(XdgMenu *menu);
+static void clean_up_icon_cache(XdgMenu *menu);
+static void clean_up_lists(XdgMenu *menu);
+static int  contains_nocase(const char *haystack, const char *needle);
+static void debug_msg(XdgMenu *menu, const char *msg, ...);
+static void extract_main_category(char *category, const char *categories);
+static void find_actions(App *app);
+static void find_all_apps(XdgMenu *menu);
+static void find_apps_in_folder(XdgMenu *menu, const char *folder);
+static void find_icon(XdgMenu *menu, char *icon_path, char *icon_name);
+static void find_icon_dirs(XdgMenu *menu);
+static Icon *find_icon_name(XdgMenu *menu, const char *icon_name);
+static void find_locales(XdgMenu *menu);
+static void gen_command(XdgMenu *menu, char *command, App *app, const char *exec);
+static void gen_entry(XdgMenu *menu, App *app);
+static void getenv_fb(XdgMenu *menu, char *dest, char *name, char *fallback, int n);
+static unsigned hash_str(const char *str);
+static int  handler_icon_dirs_theme(void *user, const char *section, const char *name, const char *value);
+static int  handler_parse_app(void *user, const char *section, const char *name, const char *value);
+static int  handler_set_icon_theme(void *user, const char *section, const char *name, const char *value);
+static void list_free(List *list);
+static void list_free_actions(App *app);
+static void list_insert(List *l, char *text, int n);
+static void list_reverse(List *l);
+static int  locale_rank(XdgMenu *menu, const char *suffix);
+static void prepare_envvars(XdgMenu *menu);
+static void set_icon_theme(XdgMenu *menu);
+static void set_localized(char *dest, int n, int *dest_rank, int rank, const char *value);
+static void split_to_list(List *list, const char *env_string, char *sep);
+
+static int cmp_app_category_name(const void *p1, const void *p2)
+{
+	int cmp_category, cmp_name;
+	App *a1 = *(App **)p1, *a2 = *(App **)p2;
+
+	cmp_category = strcmp(a1->category, a2->category);
+	/* the names may be localized, sort them as in the LC_COLLATE locale */
+	cmp_name = strcoll(a1->name, a2->name);
+	return cmp_category ? cmp_category : cmp_name;
+}
+
+static int check_app(App *app)
+{
+	if (strcmp(app->type, "Application") != 0
+		|| strlen(app->exec) == 0
+		|| strlen(app->name) == 0)
+		return 0;
+	return 1;
+}
+
+static int check_desktop(XdgMenu *menu, const char *desktop_list)
+{
+	for (List *desktop = menu->current_desktop_list.next; desktop; desktop = desktop->next)
+		if (strstr(desktop_list, desktop->text))
+			return 1;
+	return 0;
+}
+
+static int check_exec(XdgMenu *menu, const char *cmd)
+{
+	char file[MLEN] = {0};
+	struct stat sb;
+
+	/* if command start with '/', check it directly */
+	if (cmd[0] == '/')
+		return stat(cmd, &sb) == 0 && sb.st_mode & S_IXUSR;
+
+	for (List *dir = menu->path_list.next; dir; dir = dir->next) {
+		snprintf(file, MLEN, "%s/%s", dir->text, cmd);
+		if (stat(file, &sb) == 0 && sb.st_mode & S_IXUSR)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * An app folder needs a rescan if it (i.e. its list of files) or any of the
+ * desktop files in it is modified since the given time. All the desktop files
+ * are checked, since the hidden ones are not kept in the app list.
+ */
+static int check_folder_changed(XdgMenu *menu, const char *folder, time_t since)
+{
+	int len = strlen(folder), changed = 0;
+	char *ext;
+	DIR *dir;
+	struct dirent *entry;
+	struct stat sb;
+
+	/* a missing folder only matters if apps were found in it */
+	if ((dir = opendir(folder)) == NULL) {
+		for (App *app = menu->all_apps.next; app; app = app->next)
+			if (strncmp(app->entry_path, folder, len) == 0 && app->entry_path[len] == '/')
+				return 1;
+		return 0;
+	}
+
+	if (fstat(dirfd(dir), &sb) != 0 || sb.st_mtime >= since)
+		changed = 1;
+	while (!changed && (entry = readdir(dir)) != NULL) {
+		ext = strrchr(entry->d_name, '.');
+		if (!ext || strcmp(ext, ".desktop") != 0)
+			continue;
+		/* follow symbolic links, their targets are what is parsed */
+		if (fstatat(dirfd(dir), entry->d_name, &sb, 0) != 0 || sb.st_mtime >= since)
+			changed = 1;
+	}
+	closedir(dir);
+	return changed;
+}
+
+/*
+ * Check whether an icon is added to or removed from any icon dir since the
+ * last check, and reopen the changed dirs, which may be created again since.
+ */
+static int check_icon_dirs_changed(XdgMenu *menu)
+{
+	int changed = 0;
+	struct stat sb;
+
+	for (List *dir = menu->icon_dirs.next; dir; dir = dir->next) {
+		if (stat(dir->text, &sb) != 0)
+			memset(&sb, 0, sizeof(sb));
+		if (sb.st_mtim.tv_sec == dir->mtime.tv_sec && sb.st_mtim.tv_nsec == dir->mtime.tv_nsec)
+			continue;
+		debug_msg(menu, "Icon dir changed: %s\n", dir->text);
+		dir->mtime = sb.st_mtim;
+		/* the dir may have been removed and created again, reopen it */
+		if (dir->fd >= 0)
+			close(dir->fd);
+		dir->fd = open(dir->text, O_RDONLY);
+		changed = 1;
+	}
+	return changed;
+}
+
+static void clean_up_icon_cache(XdgMenu *menu)
+{
+	for (int i = 0; i < LEN(menu->icon_cache); i++) {
+		for (Icon *p = menu->icon_cache[i], *tmp; p; tmp = p->next, free(p), p = tmp) ;
+		menu->icon_cache[i] = NULL;
+	}
+}
+
+static void clean_up_lists(XdgMenu *menu)
+{
+	for (List *dir = menu->icon_dirs.next; dir; dir = dir->next)
+		if (dir->fd > 0) {
+			debug_msg(menu, "%d %s\n", dir->fd, dir->text);
+			close(dir->fd);
+		}
+	list_free(&menu->icon_dirs);
+	list_free(&menu->path_list);
+	list_free(&menu->data_dirs_list);
+	list_free(&menu->current_desktop_list);
+	clean_up_icon_cache(menu);
+	for (App *p = menu->all_apps.next, *tmp; p; tmp = p->next, list_free_actions(p), free(p), p = tmp) ;
+	menu->all_apps.next = NULL;
+
+}
+
+static int contains_nocase(const char *haystack, const char *needle)
+{
+	int len = strlen(needle);
+
+	for (; *haystack; haystack++)
+		if (strncasecmp(haystack, needle, len) == 0)
+			return 1;
+	return len == 0;
+}
+
+static void debug_msg(XdgMenu *menu, const char *msg, ...)
+{
+	if (!menu->option.debug)
+		return;
+
+	va_list args;
+	fprintf(stderr, "DEBUG: ");
+	va_start(args, msg);
+	vfprintf(stderr, msg, args);
+	va_end(args);
+}
+
+static void extract_main_category(char *category, const char *categories)
+{
+	List list_categories = {0}, *s;
+
+	split_to_list(&list_categories, categories, ";");
+	for (s = list_categories.next; s; s = s->next)
+		for (int i = 0; i < LEN(xdg_categories); i++)
+			if (strcmp(xdg_categories[i].category, s->text) == 0)
+				snprintf(category, SLEN, "%s", xdg_categories[i].name);
+
+	list_free(&list_categories);
+}
+
+/*
+ * Keep only the action groups listed in the Actions key, in the listed order.
+ * The groups themselves are collected by handler_parse_app() in the same pass.
+ */
+static void find_actions(App *app)
+{
+	List list_ids = {0};
+	Action *found = NULL, **prev, *a;
+
+	split_to_list(&list_ids, app->actions, ";");
+	/* list_ids is in reversed order, prepending to found restores it */
+	for (List *id = list_ids.next; id; id = id->next) {
+		for (prev = &app->action_list; (a = *prev); prev = &a->next)
+			if (strcmp(a->id, id->text) == 0)
+				break;
+		if (!a)
+			continue;
+		*prev = a->next;
+		if (strlen(a->name) == 0 || strlen(a->exec) == 0) {
+			free(a);
+			continue;
+		}
+		a->next = found;
+		found = a;
+	}
+	list_free(&list_ids);
+
+	/* drop the groups not listed in the Actions key */
+	list_free_actions(app);
+	app->action_list = found;
+}
+
+static void find_all_apps(XdgMenu *menu)
+{
+	char folder[MLEN] = {0};
+
+	menu->scan_time = time(NULL);
+	/* output all app in folder */
+	for (List *data_dir = menu->data_dirs_list.next; data_dir; data_dir = data_dir->next) {
+		snprintf(folder, MLEN, "%s/applications", data_dir->text);
+		find_apps_in_folder(menu, folder);
+	}
+}
+
+static void find_apps_in_folder(XdgMenu *menu, const char *folder)
+{
+	int res;
+	char path[LLEN] = {0}, *ext;
+	DIR *dir;
+	struct dirent *entry;
+	App *app;
+	ParseApp parse;
+
+	if ((dir = opendir(folder)) == NULL)
+		return;
+
+	while ((entry = readdir(dir)) != NULL) {
+		ext = strrchr(entry->d_name, '.');
+		if ((entry->d_type != DT_REG
+				&& entry->d_type != DT_LNK
+				&& entry->d_type != DT_UNKNOWN)  /* not file */
+			|| !ext || strcmp(ext, ".desktop") != 0) /* not desktop entry */
+			continue;
+
+		app = calloc(1, sizeof(App));
+		parse = (ParseApp){ menu, app, INT_MAX, INT_MAX, INT_MAX, INT_MAX };
+		snprintf(path, LLEN, "%s/%s", folder, entry->d_name);
+		debug_msg(menu, "Ini parse app entry: %s\n", path);
+		if ((res = ini_parse(path, handler_parse_app, &parse)) > 0)
+			debug_msg(menu, "%s parse failed: %d\n", path, res);
+
+		if (!app->not_show && check_app(app)) {
+			if (menu->option.actions)
+				find_actions(app);
+			snprintf(app->entry_path, LLEN, "%s", path);
+			gen_entry(menu, app);
+			if (strlen(app->category) == 0)
+				snprintf(app->category, SLEN, "%s", "Others");
+			app->next = menu->all_apps.next;
+			menu->all_apps.next = app;
+		} else {
+			list_free_actions(app);
+			free(app);
+		}
+	}
+	closedir(dir);
+}
+
+static void find_icon(XdgMenu *menu, char *icon_path, char *icon_name)
+{
+	Icon *icon;
+
+	/* provided icon is a file path */
+	if (icon_name[0] == '/') {
+		snprintf(icon_path, MLEN, "%s", access(icon_name, F_OK) == 0 ?
+				 icon_name : menu->fallback_icon_path);
+		return;
+	}
+
+	icon = find_icon_name(menu, icon_name);
+	snprintf(icon_path, MLEN, "%s", strlen(icon->path) > 0 ?
+			 icon->path : menu->fallback_icon_path);
+}
+
+/*
+ * Search an icon name in the icon dirs, only once for each name, since the
+ * results are kept in the cache whether the icon is found or not.
+ * If not found, fall back to the name with the last "-" part removed, e.g.
+ * "foo-bar-baz", "foo-bar", "foo", as in the icon theme spec.
+ */
+static Icon *find_icon_name(XdgMenu *menu, const char *icon_name)
+{
+	const char *exts[] = {"svg", "png", "xpm"};
+	char test_path[SLEN] = {0}, parent_name[SLEN] = {0}, *dash;
+	unsigned bucket = hash_str(icon_name) % LEN(menu->icon_cache);
+	Icon *icon;
+
+	for (icon = menu->icon_cache[bucket]; icon; icon = icon->next)
+		if (strcmp(icon->name, icon_name) == 0)
+			return icon;
+
+	icon = calloc(1, sizeof(Icon));
+	snprintf(icon->name, SLEN, "%s", icon_name);
+	icon->next = menu->icon_cache[bucket];
+	menu->icon_cache[bucket] = icon;
+
+	for (List *dir = menu->icon_dirs.next; dir; dir = dir->next) {
+		for (int i = 0; i < 3; i++) {
+			snprintf(test_path, SLEN, "%s.%s", icon_name, exts[i]);
+			/* use faccessat, might be faster than access
+			 * the reason is that the directory's fd is already opened */
+			if (faccessat(dir->fd, test_path, F_OK, 0) == 0) {
+				snprintf(icon->path, MLEN, "%s/%s", dir->text, test_path);
+				return icon;
+			}
+		}
+	}
+
+	debug_msg(menu, "Icon not found: %s\n", icon_name);
+	snprintf(parent_name, SLEN, "%s", icon_name);
+	if ((dash = strrchr(parent_name, '-')) != NULL) {
+		*dash = 0;
+		snprintf(icon->path, MLEN, "%s", find_icon_name(menu, parent_name)->path);
+	}
+	return icon;
+}
+
+static void find_icon_dirs(XdgMenu *menu)
+{
+	int res, len_parent;
+	char dir_parent[SLEN] = {0}, index_theme[MLEN] = {0};
+	ParseTheme theme;
+	struct stat sb;
+
+	for (List *dir = menu->data_dirs_list.next; dir; dir = dir->next) {
+		snprintf(index_theme, MLEN, "%s/icons/%s/index.theme", dir->text, menu->option.icon_theme);
+		if (access(index_theme, F_OK) == 0) {
+			/* the state as if a previous section was just finished */
+			theme = (ParseTheme){ .menu = menu, .size = -1, .minsize = -1,
+				.maxsize = -1, .threshold = 2, .scale = 1 };
+			debug_msg(menu, "Ini parse icon theme: %s\n", index_theme);
+			if ((res = ini_parse(index_theme, handler_icon_dirs_theme, &theme)) > 0)
+				debug_msg(menu, "%s parse failed: %d\n", index_theme, res);
+			/* mannually call, a hack to process the end of file */
+			handler_icon_dirs_theme(&theme, "", NULL, NULL);
+		}
+
+		/* prepend dirs with parent path */
+		len_parent = snprintf(dir_parent, SLEN, "%s/icons/%s/", dir->text, menu->option.icon_theme);
+		for (List *idir = menu->icon_dirs.next; idir; idir = idir->next) {
+			/* FIXME: This is hacky, change this */
+			if (idir->text[0] != '/') {
+				strncpy(idir->text + len_parent, idir->text, strlen(idir->text));
+				memcpy(idir->text, dir_parent, strlen(dir_parent));
+			}
+		}
+	}
+
+	list_insert(&menu->icon_dirs, "/usr/share/pixmaps", SLEN);
+	for (List *idir = menu->icon_dirs.next; idir; idir = idir->next) {
+		idir->fd = open(idir->text, O_RDONLY);
+		if (idir->fd >= 0 && fstat(idir->fd, &sb) == 0)
+			idir->mtime = sb.st_mtim;
+		debug_msg(menu, "%d %s\n", idir->fd, idir->text);
+	}
+	/* This will restore the icon directories as in index.theme file,
+	 *   which results in fewer checks of file existance (-70% in my case!).
+	 * Reason: the "apps", "category" folder will be searched earlier */
+	list_reverse(&menu->icon_dirs);
+}
+
+/*
+ * Derive the locale suffixes to match from LC_MESSAGES, in the order of the
+ * desktop entry spec: lang_COUNTRY@MODIFIER, lang_COUNTRY, lang@MODIFIER, lang.
+ * The encoding part of the locale is ignored.
+ */
+static void find_locales(XdgMenu *menu)
+{
+	/* smaller than the slots in menu->locales, which add brackets and separators */
+	char locale[SLEN / 2] = {0}, *country, *encoding, *modifier;
+	char *vars[] = {"LC_ALL", "LC_MESSAGES", "LANG"}, *env;
+
+	menu->nlocales = 0;
+	for (int i = 0; i < LEN(vars); i++)
+		if ((env = getenv(vars[i])) && strlen(env) > 0) {
+			snprintf(locale, sizeof(locale), "%s", env);
+			break;
+		}
+	if (strlen(locale) == 0 || strcmp(locale, "C") == 0 || strcmp(locale, "POSIX") == 0)
+		return;
+
+	/* split lang_COUNTRY.ENCODING@MODIFIER in place */
+	if ((modifier = strchr(locale, '@')))
+		*modifier++ = 0;
+	if ((encoding = strchr(locale, '.')))
+		*encoding = 0;
+	if ((country = strchr(locale, '_')))
+		*country++ = 0;
+
+	if (country && modifier)
+		snprintf(menu->locales[menu->nlocales++], SLEN, "[%s_%s@%s]", locale, country, modifier);
+	if (country)
+		snprintf(menu->locales[menu->nlocales++], SLEN, "[%s_%s]", locale, country);
+	if (modifier)
+		snprintf(menu->locales[menu->nlocales++], SLEN, "[%s@%s]", locale, modifier);
+	snprintf(menu->locales[menu->nlocales++], SLEN, "[%s]", locale);
+}
+
+static void gen_command(XdgMenu *menu, char *command, App *app, const char *exec)
+{
+	char *perc, field, replace_str[LLEN] = {0}, buffer[MLEN] = {0};
+
+	if (app->terminal)
+		snprintf(command, MLEN + SLEN, "%s -e %s", menu->option.terminal, exec);
+	else
+		snprintf(command, MLEN + SLEN, "%s", exec);
+
+	/* replace field codes */
+	/* search starting from right, this way the starting position stays the same */
+	while ((perc = strrchr(command, '%')) != NULL) {
+		field = *(perc + 1);
+		if (isalpha(field)) {
+			memset(replace_str, 0, MLEN);
+			if (field == 'c')
+				snprintf(replace_str, LLEN, "%s", app->entry_path);
+			else if (field == 'i' && strlen(app->icon) != 0)
+				snprintf(replace_str, LLEN, "--icon %s", app->icon);
+			else if (field == 'k')
+				snprintf(replace_str, LLEN, "%s", app->name);
+			snprintf(buffer, MLEN, "%s", perc + 2);
+			snprintf(perc, MLEN - (perc - command), "%s%s", replace_str, buffer);
+		}
+	}
+}
+
+static void gen_entry(XdgMenu *menu, App *app)
+{
+	char icon_path[MLEN] = {0}, label[MLEN * 2 + 8] = {0};
+	char name[MLEN + 4] = {0}, command[MLEN + SLEN] = {0};
+	Option *option = &menu->option;
+
+	gen_command(menu, command, app, app->exec);
+
+	if (!option->no_genname && strlen(app->genericname) > 0)
+		snprintf(name, sizeof(name), "%s (%s)", app->name, app->genericname);
+	else
+		strcpy(name, app->name);
+
+	if (!option->no_icon)
+		find_icon(menu, icon_path, app->icon);
+
+	if (option->no_icon || strlen(icon_path) == 0)
+		snprintf(label, sizeof(label), "%s", name);
+	else
+		snprintf(label, sizeof(label), "IMG:%s\t%s", icon_path, name);
+
+	/* an app with actions is a submenu, the main launch being its first item */
+	if (app->action_list) {
+		snprintf(app->xmenu_submenu, sizeof(app->xmenu_submenu), "\t%s", label);
+		snprintf(app->xmenu_entry, LLEN, "\t\t%s\t%s", label, command);
+	} else {
+		app->xmenu_submenu[0] = 0;
+		snprintf(app->xmenu_entry, LLEN, "\t%s\t%s", label, command);
+	}
+
+	for (Action *action = app->action_list; action; action = action->next) {
+		gen_command(menu, command, app, action->exec);
+		if (!option->no_icon)
+			find_icon(menu, icon_path, strlen(action->icon) > 0 ? action->icon : app->icon);
+		if (option->no_icon || strlen(icon_path) == 0)
+			snprintf(action->xmenu_entry, LLEN, "\t\t%s\t%s", action->name, command);
+		else
+			snprintf(action->xmenu_entry, LLEN, "\t\tIMG:%s\t%s\t%s",
+					 icon_path, action->name, command);
+	}
+}
+
+/* getenv with fallback value */
+static void getenv_fb(XdgMenu *menu, char *dest, char *name, char *fallback, int n)
+{
+	char *env;
+
+	if ((env = getenv(name))) {
+		snprintf(dest, n, "%s", env);
+	} else if (fallback) {
+		if (fallback[0] != '/')  /* relative path to $HOME */
+			snprintf(dest, n, "%s/%s", menu->home, fallback);
+		else
+			snprintf(dest, n, "%s", fallback);
+	}
+}
+
+/* djb2 string hash */
+static unsigned hash_str(const char *str)
+{
+	unsigned hash = 5381;
+
+	while (*str)
+		hash = hash * 33 + (unsigned char)*str++;
+	return hash;
+}
+
+/*
+ * handler for ini_parse
+ * match subdirectories in an icon theme folder by parsing an index.theme file
+ * - the icon size is options.icon_size
+ * - the icon theme will be specified as the parsed the index.theme file
+ */
+static int handler_icon_dirs_theme(void *user, const char *section, const char *name, const char *value)
+{
+	ParseTheme *t = (ParseTheme *)user;
+	Option *option = &t->menu->option;
+
+	if ((!name && !value) || strcmp(section, t->subdir) != 0) {
+		/* Check the icon size after finished parsing a section */
+		if (t->scale == option->scale
+			&& (((strcmp(t->type, "Threshold") == 0 || strlen(t->type) == 0)
+					&& abs(t->size - option->icon_size) <= t->threshold)
+				|| (strcmp(t->type, "Fixed") == 0
+					&& t->size == option->icon_size)
+				|| (strcmp(t->type, "Scalable") == 0
+					&& t->minsize <= option->icon_size
+					&& t->maxsize >= option->icon_size)))
+			/* save dirs into this linked list */
+			list_insert(&t->menu->icon_dirs, t->subdir, SLEN);
+
+		/* reset the current section */
+		snprintf(t->subdir, 32, "%s", section);
+		t->size = t->minsize = t->maxsize = -1;
+		t->threshold = 2;  /* threshold fallback value */
+		t->scale = 1;
+		memset(t->type, 0, 16);
+	}
+
+	/* save the values into the section state */
+	if (!name && !value) { /* end of the file/section */
+		return 1;
+	} else if (strcmp(name, "Size") == 0) {
+		t->size = atoi(value);
+		if (t->minsize == -1)  /* minsize fallback value */
+			t->minsize = t->size;
+		if (t->maxsize == -1)  /* maxsize fallback value */
+			t->maxsize = t->size;
+	} else if (strcmp(name, "MinSize") == 0) {
+		t->minsize = atoi(value);
+	} else if (strcmp(name, "MaxSize") == 0) {
+		t->maxsize = atoi(value);
+	} else if (strcmp(name, "Threshold") == 0) {
+		t->threshold = atoi(value);
+	} else if (strcmp(name, "Scale") == 0) {
+		t->scale = atoi(value);
+	} else if (strcmp(name, "Type") == 0) {
+		snprintf(t->type, 16, "%s", value);
+	}
+
+	return 1;
+}
+
+/* Handler for ini_parse, parse app info and save in App variable of *user */
+static int handler_parse_app(void *user, const char *section, const char *name, const char *value)
+{
+	ParseApp *p = (ParseApp *)user;
+	XdgMenu *menu = p->menu;
+	App *app = p->app;
+	Action *action;
+	char *suffix;
+	int rank;
+
+	/* localized keys, skip them early unless the locale is a match */
+	if ((suffix = strchr(name, '[')) != NULL) {
+		if ((rank = locale_rank(menu, suffix)) < 0)
+			return 1;
+	} else {
+		rank = menu->nlocales;  /* the unlocalized value ranks last */
+	}
+
+	if (strcmp(section, "Desktop Entry") == 0) {
+		if (suffix) {
+			if (strncmp(name, "Name[", 5) == 0)
+				set_localized(app->name, SLEN, &p->rank_name, rank, value);
+			else if (strncmp(name, "GenericName[", 12) == 0)
+				set_localized(app->genericname, SLEN, &p->rank_genericname, rank, value);
+			else if (strncmp(name, "Comment[", 8) == 0)
+				set_localized(app->comment, MLEN, &p->rank_comment, rank, value);
+			return 1;
+		}
+
+		if (strcmp(name, "Exec") == 0)
+			snprintf(app->exec, MLEN, "%s", value);
+		else if (strcmp(name, "Type") == 0)
+			snprintf(app->type, SLEN, "%s", value);
+		else if (strcmp(name, "Icon") == 0)
+			snprintf(app->icon, SLEN, "%s", value);
+		else if (strcmp(name, "Name") == 0)
+			set_localized(app->name, SLEN, &p->rank_name, rank, value);
+		else if (strcmp(name, "Terminal") == 0)
+			app->terminal = strcmp(value, "true") == 0;
+		else if (strcmp(name, "GenericName") == 0)
+			set_localized(app->genericname, SLEN, &p->rank_genericname, rank, value);
+		else if (strcmp(name, "Comment") == 0)
+			set_localized(app->comment, MLEN, &p->rank_comment, rank, value);
+		else if (strcmp(name, "Categories") == 0)
+			extract_main_category(app->category, value);
+		else if (strcmp(name, "Path") == 0)
+			snprintf(app->path, MLEN, "%s", value);
+		else if (strcmp(name, "Actions") == 0)
+			snprintf(app->actions, MLEN, "%s", value);
+
+		if ((strcmp(name, "NoDisplay") == 0 && strcmp(value, "true") == 0)
+			|| (strcmp(name, "Hidden") == 0 && strcmp(value, "true") == 0)
+			|| (strcmp(name, "Type") == 0 && strcmp(value, "Application") != 0)
+			|| (strcmp(name, "TryExec") == 0 && check_exec(menu, value) == 0)
+			|| (strcmp(name, "NotShowIn") == 0 && check_desktop(menu, value))
+			|| (strcmp(name, "OnlyShowIn") == 0 && !check_desktop(menu, value)))
+			app->not_show = 1;
+	} else if (menu->option.actions && strncmp(section, "Desktop Action ", 15) == 0) {
+		/* collect every action group, the Actions key is checked afterwards */
+		if (!app->action_list || strcmp(app->action_list->id, section + 15) != 0) {
+			action = calloc(1, sizeof(Action));
+			snprintf(action->id, SLEN, "%s", section + 15);
+			action->next = app->action_list;
+			app->action_list = action;
+			p->rank_action_name = INT_MAX;
+		}
+		action = app->action_list;
+		if (strncmp(name, "Name", 4) == 0 && (name[4] == 0 || name[4] == '['))
+			set_localized(action->name, SLEN, &p->rank_action_name, rank, value);
+		else if (suffix)
+			return 1;
+		else if (strcmp(name, "Exec") == 0)
+			snprintf(action->exec, MLEN, "%s", value);
+		else if (strcmp(name, "Icon") == 0)
+			snprintf(action->icon, SLEN, "%s", value);
+	}
+	return 1;
+}
+
+static int handler_set_icon_theme(void *user, const char *section, const char *name, const char *value)
+{
+	XdgMenu *menu = (XdgMenu *)user;
+
+	if (strcmp(section, "Settings") == 0 && strcmp(name, "gtk-icon-theme-name") == 0)
+		snprintf(menu->icon_theme, SLEN, "%s", value);
+	return 1;
+}
+
+static void list_free(List *list)
+{
+	List *p = list->next, *tmp;
+
+	list->next = NULL;
+	while (p) {
+		tmp = p->next;
+		free(p);
+		p = tmp;
+	}
+}
+
+static void list_free_actions(App *app)
+{
+	Action *p = app->action_list, *tmp;
+
+	app->action_list = NULL;
+	while (p) {
+		tmp = p->next;
+		free(p);
+		p = tmp;
+	}
+}
+
+static void list_insert(List *list, char *text, int n)
+{
+	List *tmp;
+
+	tmp = calloc(1, sizeof(List));
+	snprintf(tmp->text, n, "%s", text);
+	tmp->next = list->next;
+	list->next = tmp;
+}
+
+static void list_reverse(List *list)
+{
+	List *curr = list->next, *next;
+
+	list->next = NULL;
+	while (curr) {
+		next = curr->next;
+		curr->next = list->next;
+		list->next = curr;
+		curr = next;
+	}
+}
+
+/* The rank of a key's locale suffix like "[de_DE]", -1 if not a match */
+static int locale_rank(XdgMenu *menu, const char *suffix)
+{
+	for (int i = 0; i < menu->nlocales; i++)
+		if (strcmp(suffix, menu->locales[i]) == 0)
+			return i;
+	return -1;
+}
+
+static void prepare_envvars(XdgMenu *menu)
+{
+	char path[LLEN] = {0}, xdg_data_home[SLEN] = {0}, xdg_data_dirs[LLEN] = {0};
+	char xdg_current_desktop[SLEN] = {0}, data_dirs[LLEN + MLEN] = {0};
+
+	getenv_fb(menu, path, "PATH", NULL, LLEN);
+	getenv_fb(menu, menu->home, "HOME", NULL, SLEN);
+	getenv_fb(menu, xdg_data_home, "XDG_DATA_HOME", ".local/share", SLEN);
+	getenv_fb(menu, xdg_data_dirs, "XDG_DATA_DIRS", "/usr/share:/usr/local/share", LLEN);
+	getenv_fb(menu, menu->xdg_config_home, "XDG_CONFIG_HOME", ".config", SLEN);
+	getenv_fb(menu, xdg_current_desktop, "XDG_CURRENT_DESKTOP", NULL, SLEN);
+	snprintf(data_dirs, LLEN + MLEN, "%s:%s", xdg_data_dirs, xdg_data_home);
+
+	split_to_list(&menu->path_list, path, ":");
+	split_to_list(&menu->data_dirs_list, data_dirs, ":");
+	split_to_list(&menu->current_desktop_list, xdg_current_desktop, ":");
+	find_locales(menu);
+}
+
+static void set_icon_theme(XdgMenu *menu)
+{
+	int res;
+	char gtk3_settings[MLEN] = {0}, *real_path;
+
+	if (menu->option.icon_theme && strlen(menu->option.icon_theme) > 0)
+		return;
+	snprintf(menu->icon_theme, SLEN, "%s", "hicolor");
+	menu->option.icon_theme = menu->icon_theme;
+
+	/* Check gtk3 settings.ini file and overwrite default icon theme */
+	snprintf(gtk3_settings, MLEN, "%s/gtk-3.0/settings.ini", menu->xdg_config_home);
+	if (access(gtk3_settings, F_OK) == 0) {
+		real_path = realpath(gtk3_settings, NULL);
+		debug_msg(menu, "Ini parse gtk settings: %s\n", real_path);
+		if ((res = ini_parse(real_path, handler_set_icon_theme, menu)) > 0)
+			debug_msg(menu, "failed parse gtk settings: line %d\n", res);
+		free(real_path);
+	}
+}
+
+/* keep the value with the best ranked locale, ties go to the later one */
+static void set_localized(char *dest, int n, int *dest_rank, int rank, const char *value)
+{
+	if (rank > *dest_rank)
+		return;
+	*dest_rank = rank;
+	snprintf(dest, n, "%s", value);
+}
+
+/* split with strtok_r, since strtok keeps its position in a static variable */
+static void split_to_list(List *list, const char *env_string, char *sep)
+{
+	char *buffer = strdup(env_string), *saveptr;
+
+	for (char *p = strtok_r(buffer, sep, &saveptr); p; p = strtok_r(NULL, sep, &saveptr))
+		list_insert(list, p, SLEN);
+	free(buffer);
+}
+
+Option xdgmenu_default_option()
+{
+	return (Option){
+		.fallback_icon = "application-x-executable",
+		.icon_size = 24,
+		.scale = 1,
+		.terminal = "xterm"
+	};
+}
+
+XdgMenu *xdgmenu_new(Option option)
+{
+	XdgMenu *menu = calloc(1, sizeof(XdgMenu));
+
+	menu->option = option;
+	return menu;
+}
+
+void xdgmenu_scan(XdgMenu *menu)
+{
+	/* forget the results of a previous scan, including the icon theme from
+	 * the gtk settings, which is looked up again */
+	clean_up_lists(menu);
+	if (menu->option.icon_theme == menu->icon_theme)
+		menu->option.icon_theme = NULL;
+	menu->fallback_icon_path[0] = 0;
+	menu->nlocales = 0;
+	menu->scan_time = 0;
+
+	prepare_envvars(menu);
+	set_icon_theme(menu);
+	if (!menu->option.no_icon) {
+		find_icon_dirs(menu);
+		find_icon(menu, menu->fallback_icon_path, menu->option.fallback_icon);
+	}
+	find_all_apps(menu);
+}
+
+App *xdgmenu_query(XdgMenu *menu, App *from, const char *text)
+{
+	for (App *app = from ? from->next : menu->all_apps.next; app; app = app->next)
+		if (contains_nocase(app->name, text)
+			|| contains_nocase(app->genericname, text)
+			|| contains_nocase(app->comment, text))
+			return app;
+	return NULL;
+}
+
+void xdgmenu_dump(XdgMenu *menu, FILE *fp)
+{
+	int i, count;
+	char icon_path[MLEN] = {0}, *curcat = NULL;
+	App **app_array, *app;
+
+	/* construct an array of apps from the linked list */
+	for (count = 0, app = menu->all_apps.next; app; count++, app = app->next)
+		; /* count the apps */
+	app_array = calloc(count + 1, sizeof(App *));
+	for (i = 0, app = menu->all_apps.next; app; i++, app = app->next)
+		app_array[i] = app;
+
+	qsort(app_array, count, sizeof(App *), cmp_app_category_name);
+	for (i = 0; i < count; i++) {
+		app = app_array[i];
+		if (!curcat || strcmp(curcat, app->category)) {
+			curcat = app->category;
+			if (!menu->option.no_icon)
+				for (int j = 0; j < LEN(category_icons); j++)
+					if (strcmp(app->category, category_icons[j].category) == 0) {
+						find_icon(menu, icon_path, category_icons[j].icon);
+						break;
+					}
+			if (menu->option.no_icon || strlen(icon_path) == 0)
+				fprintf(fp, "%s\n", curcat);
+			else
+				fprintf(fp, "IMG:%s\t%s\n", icon_path, curcat);
+		}
+		if (strlen(app->xmenu_submenu) > 0)
+			fprintf(fp, "%s\n", app->xmenu_submenu);
+		fprintf(fp, "%s\n", app->xmenu_entry);
+		for (Action *action = app->action_list; action; action = action->next)
+			fprintf(fp, "%s\n", action->xmenu_entry);
+	}
+	free(app_array);
+}
+
+int xdgmenu_refresh(XdgMenu *menu)
+{
+	int count = 0, len;
+	char folder[MLEN] = {0};
+	time_t last_scan = menu->scan_time;
+	App **prev, *app;
+
+	menu->scan_time = time(NULL);
+
+	/* forget the icons found or not found, if icons may be added or removed */
+	if (!menu->option.no_icon && check_icon_dirs_changed(menu)) {
+		clean_up_icon_cache(menu);
+		menu->fallback_icon_path[0] = 0;
+		find_icon(menu, menu->fallback_icon_path, menu->option.fallback_icon);
+		for (app = menu->all_apps.next; app; app = app->next)
+			gen_entry(menu, app);
+	}
+
+	for (List *data_dir = menu->data_dirs_list.next; data_dir; data_dir = data_dir->next) {
+		len = snprintf(folder, MLEN, "%s/applications", data_dir->text);
+		if (!check_folder_changed(menu, folder, last_scan))
+			continue;
+
+		debug_msg(menu, "Rescan app folder: %s\n", folder);
+		/* drop the apps found in this folder and find them again */
+		for (prev = &menu->all_apps.next; (app = *prev); ) {
+			if (strncmp(app->entry_path, folder, len) == 0 && app->entry_path[len] == '/') {
+				*prev = app->next;
+				list_free_actions(app);
+				free(app);
+			} else {
+				prev = &app->next;
+			}
+		}
+		find_apps_in_folder(menu, folder);
+		count++;
+	}
+	return count;
+}
+
+void xdgmenu_free(XdgMenu *menu)
+{
+	clean_up_lists(menu);
+	free(menu);
+}
@@ -0,0 +1,88 @@
+/* Author: Lu Xu <oliver_lew at outlook dot com>
+ * License: MIT
+ * References: https://specifications.freedesktop.org/desktop-entry-spec
+ *             https://specifications.freedesktop.org/icon-theme-spec
+ *
+ * libxdgmenu: find the apps and icons following the XDG specifications.
+ * All the state lives in an XdgMenu context, so several contexts can be used
+ * at the same time, e.g. in different threads, or kept alive in a long-running
+ * process and refreshed when the desktop entries change.
+ */
+
+#ifndef XDGMENU_H
+#define XDGMENU_H
+
+#include <stdio.h>
+
+/* sizes of the text fields of the apps */
+#define XDGMENU_LLEN 1024
+#define XDGMENU_MLEN 256
+#define XDGMENU_SLEN 128
+
+typedef struct XdgMenuAction {
+	/* from desktop action group */
+	char exec[XDGMENU_MLEN];
+	char icon[XDGMENU_SLEN];
+	char id[XDGMENU_SLEN];
+	char name[XDGMENU_SLEN];
+	/* derived attributes */
+	char xmenu_entry[XDGMENU_LLEN];
+	struct XdgMenuAction *next;
+} XdgMenuAction;
+
+typedef struct XdgMenuApp {
+	/* from desktop entry file */
+	char actions[XDGMENU_MLEN];
+	char category[XDGMENU_SLEN];
+	char comment[XDGMENU_MLEN];
+	char exec[XDGMENU_MLEN];
+	char genericname[XDGMENU_SLEN];
+	char icon[XDGMENU_SLEN];
+	char name[XDGMENU_SLEN];
+	char path[XDGMENU_MLEN];
+	char type[XDGMENU_SLEN];
+	int terminal;
+	/* derived attributes */
+	char entry_path[XDGMENU_LLEN];
+	char xmenu_entry[XDGMENU_LLEN];
+	char xmenu_submenu[XDGMENU_MLEN * 2 + 16];  /* the header line if there are actions */
+	int not_show;
+	XdgMenuAction *action_list;
+	struct XdgMenuApp *next;
+} XdgMenuApp;
+
+typedef struct XdgMenuOption {
+	char *fallback_icon;
+	char *icon_theme;
+	char *terminal;
+	int actions;
+	int debug;
+	int icon_size;
+	int no_genname;
+	int no_icon;
+	int scale;
+} XdgMenuOption;
+
+/* the context, its content is private */
+typedef struct XdgMenu XdgMenu;
+
+/* The default options, to be modified and passed to xdgmenu_new() */
+XdgMenuOption xdgmenu_default_option();
+/* Create a context with the given options, free it with xdgmenu_free() */
+XdgMenu *xdgmenu_new(XdgMenuOption option);
+/* Read the environment, index the icon theme and find all the apps.
+ * Scanning again starts over, dropping the results of the previous scan */
+void xdgmenu_scan(XdgMenu *menu);
+/* Find the next app after *from (or the first one if NULL) matching text.
+ * The apps belong to the context: a returned pointer, also as *from, is only
+ * valid until the next xdgmenu_scan(), xdgmenu_refresh() or xdgmenu_free() */
+XdgMenuApp *xdgmenu_query(XdgMenu *menu, XdgMenuApp *from, const char *text);
+/* Write the menu in xmenu format */
+void xdgmenu_dump(XdgMenu *menu, FILE *fp);
+/* Rescan the app folders changed since the last scan, return their number.
+ * The icons are searched again if any icon dir is changed. The apps of the
+ * rescanned folders are freed, see xdgmenu_query() */
+int xdgmenu_refresh(XdgMenu *menu);
+void xdgmenu_free(XdgMenu *menu);
+
+#endif